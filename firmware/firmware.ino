@@ -21,9 +21,11 @@
 #include "display_controller.h"
 #include "input_controller.h"
 #include "magspoof.h"
+#include "mifare_restore.h"
 #include "nfc_config.h"
 #include "nfc_controller.h"
 #include "nfc_display.h"
+#include "reader_capture.h"
 
 // Display configuration
 #define SCREEN_WIDTH   128   // OLED display width in pixels
@@ -44,6 +46,9 @@
 #define MAX_MENU_ITEMS 10  // Maximum items per menu level
 #define DISPLAY_ROWS   3   // Maximum displayed items on screen
 
+// Reader log configuration
+#define CAPTURE_PAGE_BYTES 20  // Frame bytes shown per page, 2 rows of 10
+
 // Read/Write block configuration
 // Block to be read
 #define BLK_NB_MFC 4
@@ -68,6 +73,15 @@ Electroniccats_PN7150 nfc(PN7150_IRQ, PN7150_VEN, PN7150_ADDR, PN7150, &Wire);
  */
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
+/**
+ * @brief MIFARE Classic image used by the clone applications
+ */
+MifareImage cardImage;
+MifareImage uploadImage;
+const uint8_t cardKey[] = {KEY_MFC};
+uint8_t restoreFlags = 0;
+MifareReport cardReport;
+
 // Menu item type
 typedef enum {
   MENU_TYPE_SUBMENU,  // Has submenu
@@ -77,8 +91,15 @@ typedef enum {
 // Forward declarations of menu action functions
 void runDetectTags();
 void runDetectReaders();
+void runReaderLog();
+void runExportReaderLog();
+void runClearReaderLog();
 void runReadBlock();
 void runWriteBlock();
+void runDumpCard();
+void runUploadImage();
+void runRestoreCard();
+void runRestoreCardUnlocked();
 void runMagspoof();
 void runMagspoofSetup();
 void setupTracks(String newTrack1 = "", String newTrack2 = "");
@@ -103,7 +124,15 @@ typedef struct {
 } Menu;
 
 // Menu definitions
-enum { MENU_MAIN = 0, MENU_APPS, MENU_NFC, MENU_MAGSPOOF, MENU_COUNT };
+enum {
+  MENU_MAIN = 0,
+  MENU_APPS,
+  MENU_NFC,
+  MENU_READER_LOG,
+  MENU_CLONE,
+  MENU_MAGSPOOF,
+  MENU_COUNT
+};
 
 /**
  * @brief Menu controller class
@@ -161,11 +190,29 @@ Menu menus[MENU_COUNT] = {
 
     // NFC Menu
     {"NFC",
-     4,
+     6,
      {{"Detect Tags", MENU_TYPE_FUNCTION, {.function = runDetectTags}},
       {"Detect Readers", MENU_TYPE_FUNCTION, {.function = runDetectReaders}},
+      {"Reader log", MENU_TYPE_SUBMENU, {.submenuId = MENU_READER_LOG}},
       {"Read block", MENU_TYPE_FUNCTION, {.function = runReadBlock}},
-      {"Write block", MENU_TYPE_FUNCTION, {.function = runWriteBlock}}}},
+      {"Write block", MENU_TYPE_FUNCTION, {.function = runWriteBlock}},
+      {"Clone", MENU_TYPE_SUBMENU, {.submenuId = MENU_CLONE}}}},
+
+    // Reader Log Menu
+    {"Reader log",
+     3,
+     {{"View log", MENU_TYPE_FUNCTION, {.function = runReaderLog}},
+      {"Export log", MENU_TYPE_FUNCTION, {.function = runExportReaderLog}},
+      {"Clear log", MENU_TYPE_FUNCTION, {.function = runClearReaderLog}}}},
+
+    // Clone Menu
+    {"Clone",
+     4,
+     {{"Dump card", MENU_TYPE_FUNCTION, {.function = runDumpCard}},
+      {"Upload image", MENU_TYPE_FUNCTION, {.function = runUploadImage}},
+      {"Restore card", MENU_TYPE_FUNCTION, {.function = runRestoreCard}},
+      {"Restore all", MENU_TYPE_FUNCTION,
+       {.function = runRestoreCardUnlocked}}}},
 
     // Magspoof Menu
     {"Magspoof",
@@ -406,6 +453,7 @@ void runDetectReaders() {
   uint8_t animFrame = 0;
   unsigned long lastAnimUpdate = 0;
   boolean readerFound = false;
+  uint16_t framesCaptured = 0;
 
   // Wait for reader detection or back button
   while (!inputController.isBackPressed()) {
@@ -413,7 +461,7 @@ void runDetectReaders() {
 
     if (nfc.isReaderDetected()) {
       readerFound = true;
-      nfc.handleCardEmulation();
+      framesCaptured = captureCardEmulation(nfc);
       nfc.closeCommunication();
       break;
     }
@@ -424,6 +472,8 @@ void runDetectReaders() {
     display->setCursor(0, 0);
     display->println(F("Reader detected!"));
     display->println(F("Emulation complete"));
+    display->print(F("Frames logged: "));
+    display->println(framesCaptured);
     display->println(F("Press BACK button"));
     display->display();
 
@@ -437,6 +487,169 @@ void runDetectReaders() {
   nfc.reset();
 }
 
+/**
+ * @brief Draw one captured reader frame on the display
+ *
+ * Two rows of 10 bytes fit the 128x32 screen. Longer frames show "+N" for
+ * the bytes left after this page and "@N" for the first byte shown.
+ *
+ * @param index Position of the frame in the capture log
+ * @param offset First stored byte to draw
+ */
+void renderCapturedFrame(uint16_t index, uint8_t offset) {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  const CapturedFrame* frame = readerCapture.getFrame(index);
+  uint8_t stored = min(frame->length, (uint8_t) CAPTURE_FRAME_BYTES);
+  char line[22];
+
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+
+  uint8_t pos = snprintf(line, sizeof(line), "#%u/%u S%u", index + 1,
+                         readerCapture.getCount(), frame->session);
+  if (offset > 0) {
+    snprintf(&line[pos], sizeof(line) - pos, " @%u", offset);
+  } else if (stored > CAPTURE_PAGE_BYTES) {
+    snprintf(&line[pos], sizeof(line) - pos, " +%u",
+             stored - CAPTURE_PAGE_BYTES);
+  }
+  display->println(line);
+  snprintf(line, sizeof(line), "+%luus len %u",
+           (unsigned long) readerCapture.getGapUs(index), frame->length);
+  display->println(line);
+
+  for (uint8_t row = 0; row < 2; row++) {
+    uint8_t first = offset + row * 10;
+    pos = 0;
+    for (uint8_t b = first; b < stored && b < first + 10; b++) {
+      pos += snprintf(&line[pos], sizeof(line) - pos, "%02X", frame->data[b]);
+    }
+    line[pos] = '\0';
+    display->println(line);
+  }
+
+  display->display();
+}
+
+/**
+ * @brief Tell the user the reader log is empty and wait for BACK
+ */
+void showReaderLogEmpty() {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Reader log empty"));
+  display->println(F("Run Detect Readers"));
+  display->println(F("Press BACK to"));
+  display->println(F("return to menu"));
+  display->display();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+    delay(10);
+  }
+}
+
+void runReaderLog() {
+  uint16_t index = 0;
+  uint8_t offset = 0;
+
+  if (readerCapture.getCount() == 0) {
+    showReaderLogEmpty();
+    return;
+  }
+
+  // UP/DOWN browse frames, SELECT pages through the bytes of long frames
+  renderCapturedFrame(index, offset);
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+
+    if (inputController.isUpPressed() && index > 0) {
+      index--;
+      offset = 0;
+      renderCapturedFrame(index, offset);
+    } else if (inputController.isDownPressed() &&
+               index < readerCapture.getCount() - 1) {
+      index++;
+      offset = 0;
+      renderCapturedFrame(index, offset);
+    } else if (inputController.isSelectPressed()) {
+      const CapturedFrame* frame = readerCapture.getFrame(index);
+      uint8_t stored = min(frame->length, (uint8_t) CAPTURE_FRAME_BYTES);
+      offset += CAPTURE_PAGE_BYTES;
+      if (offset >= stored) {
+        offset = 0;
+      }
+      renderCapturedFrame(index, offset);
+    }
+
+    delay(10);
+  }
+}
+
+void runExportReaderLog() {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+
+  if (readerCapture.getCount() == 0) {
+    showReaderLogEmpty();
+    return;
+  }
+
+  // Buttons are not read while the log is sent, which takes a few seconds
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Exporting..."));
+  display->print(F("Frames: "));
+  display->println(readerCapture.getCount());
+  display->println(F("Serial 9600 baud"));
+  display->display();
+
+  readerCapture.exportToSerial();
+
+  display->clearDisplay();
+  display->setCursor(0, 0);
+  display->println(F("Export complete"));
+  display->println(F("Press BACK to"));
+  display->println(F("return to menu"));
+  display->display();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+    delay(10);
+  }
+}
+
+void runClearReaderLog() {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Clear reader log?"));
+  display->println(F("SELECT to clear"));
+  display->println(F("BACK to cancel"));
+  display->display();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+
+    if (inputController.isSelectPressed()) {
+      readerCapture.clear();
+
+      display->clearDisplay();
+      display->setCursor(0, 0);
+      display->println(F("Reader log cleared"));
+      display->println(F("Press BACK to"));
+      display->println(F("return to menu"));
+      display->display();
+    }
+
+    delay(10);
+  }
+}
+
 bool mifare_read_block(void) {
   Adafruit_SSD1306* display = displayController.getDisplay();
   display->setTextColor(SSD1306_WHITE);
@@ -723,6 +936,209 @@ void runWriteBlock() {
   }
 }
 
+/**
+ * @brief Run a MIFARE Classic operation on the next detected tag
+ *
+ * Shows the operation statistics once the action finishes.
+ *
+ * @param action Operation to run, fills cardReport
+ */
+void runMifareCardAction(bool (*action)(void)) {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Detecting tags..."));
+  display->println(F("Place tag near"));
+  display->println(F("the antenna"));
+  display->display();
+
+  // Set card reader/writer mode - required for tag detection
+  nfc.setReaderWriterMode();
+
+  bool tagDetected = false;
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+
+    if (nfc.isTagDetected()) {
+      tagDetected = true;
+
+      display->clearDisplay();
+      display->setCursor(0, 0);
+
+      if (nfc.remoteDevice.getProtocol() == nfc.protocol.MIFARE) {
+        display->println(F("Tag detected!"));
+        display->println(F("Keep it in place..."));
+        display->display();
+
+        bool success = action();
+        mifarePrintReport(cardReport);
+
+        char line[22];
+        display->clearDisplay();
+        display->setCursor(0, 0);
+        display->println(success ? "Done!" : cardReport.error);
+        snprintf(line, sizeof(line), "R:%u W:%u U:%u S:%u",
+                 cardReport.blocksRead, cardReport.blocksWritten,
+                 cardReport.blocksUnchanged, cardReport.blocksSkipped);
+        display->println(line);
+        snprintf(line, sizeof(line), "X:%u RT:%u %lums",
+                 cardReport.blocksRejected, cardReport.roundTrips,
+                 (unsigned long) cardReport.elapsedMs);
+        display->println(line);
+      } else {
+        display->println(F("Tag detected!"));
+        display->println(F("but it is not Mifare"));
+      }
+      display->display();
+
+      nfc.waitForTagRemoval();
+    }
+
+    nfc.reset();
+    delay(10);
+
+    if (tagDetected) {
+      break;
+    }
+  }
+
+  if (tagDetected) {
+    display->println(F("Press BACK button"));
+    display->display();
+  } else {
+    display->clearDisplay();
+    display->setTextColor(SSD1306_WHITE);
+    display->setCursor(0, 0);
+    display->println(F("No tag detected"));
+    display->println(F("Press BACK to"));
+    display->println(F("return to menu"));
+    display->display();
+  }
+
+  nfc.reset();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+    delay(10);
+  }
+}
+
+bool mifare_dump_card(void) {
+  if (!mifareDumpCard(nfc, cardKey, cardImage, cardReport)) {
+    return false;
+  }
+
+  mifareExportImage(cardImage);
+  return true;
+}
+
+bool mifare_restore_card(void) {
+  return mifareRestoreCard(nfc, cardKey, cardImage, restoreFlags, cardReport);
+}
+
+void runDumpCard() {
+  runMifareCardAction(mifare_dump_card);
+}
+
+void runUploadImage() {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Connect to a PC"));
+  display->println(F("to upload the image"));
+  display->println(F("Press BACK to"));
+  display->println(F("return to menu"));
+  display->display();
+
+  bool uploadComplete = false;
+
+  // Time tracking for periodic serial messages
+  unsigned long lastSerialPrompt = 0;
+  const unsigned long serialPromptInterval = 5000;  // 5 seconds
+
+  // Lines go to uploadImage so BACK keeps the current image
+  mifareClearImage(uploadImage);
+  Serial.println("Send image lines as BB:HEX, finish with 'end':");
+  lastSerialPrompt = millis();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+
+    if (!uploadComplete) {
+      unsigned long currentTime = millis();
+      if (uploadImage.validMask == 0 &&
+          currentTime - lastSerialPrompt >= serialPromptInterval) {
+        Serial.println("Send image lines as BB:HEX, finish with 'end':");
+        lastSerialPrompt = currentTime;
+      }
+
+      if (Serial.available() > 0) {
+        String input = Serial.readStringUntil('\n');
+        input.trim();  // Remove any whitespace
+
+        if (input == "end") {
+          // Count distinct blocks, lines may repeat a block
+          uint8_t blocksReceived = __builtin_popcountll(uploadImage.validMask);
+          Serial.println("Blocks received: " + String(blocksReceived));
+
+          display->clearDisplay();
+          display->setCursor(0, 0);
+          if (blocksReceived > 0) {
+            memcpy(&cardImage, &uploadImage, sizeof(cardImage));
+            display->println(F("Image updated!"));
+          } else {
+            display->println(F("No blocks received"));
+          }
+          display->print(F("Blocks: "));
+          display->println(blocksReceived);
+          display->println(F("Press BACK to return"));
+          display->display();
+
+          uploadComplete = true;
+        } else if (input.length() > 0 && !input.startsWith("#")) {
+          if (!mifareParseImageLine(uploadImage, input)) {
+            Serial.println("Invalid line: " + input);
+          }
+        }
+      }
+    }
+
+    delay(10);
+  }
+}
+
+void runRestoreCard() {
+  restoreFlags = 0;
+  runMifareCardAction(mifare_restore_card);
+}
+
+void runRestoreCardUnlocked() {
+  Adafruit_SSD1306* display = displayController.getDisplay();
+  display->clearDisplay();
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->println(F("Writes block 0 and"));
+  display->println(F("sector trailers!"));
+  display->println(F("SELECT to continue"));
+  display->println(F("BACK to cancel"));
+  display->display();
+
+  while (!inputController.isBackPressed()) {
+    inputController.update();
+
+    if (inputController.isSelectPressed()) {
+      restoreFlags = RESTORE_UNLOCK_BLOCK0 | RESTORE_UNLOCK_TRAILERS;
+      runMifareCardAction(mifare_restore_card);
+      restoreFlags = 0;
+      return;
+    }
+
+    delay(10);
+  }
+}
+
 void runMagspoofSetup() {
   Adafruit_SSD1306* display = displayController.getDisplay();
   display->clearDisplay();
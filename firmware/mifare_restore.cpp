@@ -0,0 +1,483 @@
+/**
+ * @file mifare_restore.cpp
+ * @brief Implementation of MIFARE Classic dump and restore functions
+ * @author Francisco Torres - Electronic Cats - electroniccats.com
+ * @date May 2025
+ */
+
+#include "mifare_restore.h"
+
+// Dump target, copied to the caller's image only once the whole card is read
+static MifareImage dumpImage;
+
+static const uint8_t zeroKey[6] = {0};
+
+/**
+ * @brief Send a command to the tag and count the round trip
+ *
+ * @param nfc Reference to NFC controller object
+ * @param cmd Command bytes
+ * @param cmdSize Number of command bytes
+ * @param resp Buffer receiving the answer
+ * @param respSize Number of answer bytes
+ * @param report Statistics updated with the round trip
+ * @param ack Expected status byte at the end of the answer
+ * @return bool true if the command succeeded
+ */
+static bool tagCommand(Electroniccats_PN7150& nfc,
+                       unsigned char* cmd,
+                       unsigned char cmdSize,
+                       unsigned char* resp,
+                       unsigned char* respSize,
+                       MifareReport& report,
+                       uint8_t ack = 0x00) {
+  report.roundTrips++;
+  bool status = nfc.readerTagCmd(cmd, cmdSize, resp, respSize);
+  return (status != NFC_ERROR) && (*respSize > 0) &&
+         (resp[*respSize - 1] == ack);
+}
+
+/**
+ * @brief Authenticate a sector with key A
+ */
+static bool authenticateSector(Electroniccats_PN7150& nfc,
+                               uint8_t sector,
+                               const uint8_t key[6],
+                               MifareReport& report) {
+  unsigned char Resp[256];
+  unsigned char RespSize;
+  unsigned char Auth[] = {0x40,   sector, 0x10,   key[0], key[1],
+                          key[2], key[3], key[4], key[5]};
+
+  if (!tagCommand(nfc, Auth, sizeof(Auth), Resp, &RespSize, report)) {
+    report.error = "Auth error!";
+    return false;
+  }
+
+  report.sectorsAuthenticated++;
+  return true;
+}
+
+/**
+ * @brief Read a block of an already authenticated sector
+ */
+static bool readBlock(Electroniccats_PN7150& nfc,
+                      uint8_t block,
+                      uint8_t* data,
+                      MifareReport& report) {
+  unsigned char Resp[256];
+  unsigned char RespSize;
+  unsigned char Read[] = {0x10, 0x30, block};
+
+  // Answer is the 0x10 header, the block data and the status byte
+  if (!tagCommand(nfc, Read, sizeof(Read), Resp, &RespSize, report) ||
+      RespSize < MFC_BLOCK_SIZE + 2) {
+    report.error = "Error reading block!";
+    return false;
+  }
+
+  memcpy(data, &Resp[1], MFC_BLOCK_SIZE);
+  report.blocksRead++;
+  return true;
+}
+
+/**
+ * @brief Write a block of an already authenticated sector
+ */
+static bool writeBlock(Electroniccats_PN7150& nfc,
+                       uint8_t block,
+                       const uint8_t* data,
+                       MifareReport& report) {
+  unsigned char Resp[256];
+  unsigned char RespSize;
+  unsigned char WritePart1[] = {0x10, 0xA0, block};
+  unsigned char WritePart2[MFC_BLOCK_SIZE + 1] = {0x10};
+
+  memcpy(&WritePart2[1], data, MFC_BLOCK_SIZE);
+
+  // Determine ChipWriteAck based on chip model
+  uint8_t ChipWriteAck = (nfc.getChipModel() == PN7160) ? 0x14 : 0x00;
+
+  if (!tagCommand(nfc, WritePart1, sizeof(WritePart1), Resp, &RespSize, report,
+                  ChipWriteAck) ||
+      !tagCommand(nfc, WritePart2, sizeof(WritePart2), Resp, &RespSize, report,
+                  ChipWriteAck)) {
+    report.error = "Error writing block!";
+    return false;
+  }
+
+  return true;
+}
+
+static bool isTrailer(uint8_t block) {
+  return (block % MFC_BLOCKS_PER_SECTOR) == MFC_BLOCKS_PER_SECTOR - 1;
+}
+
+static bool isProtected(uint8_t block, uint8_t flags) {
+  if (block == 0) {
+    return !(flags & RESTORE_UNLOCK_BLOCK0);
+  }
+  if (isTrailer(block)) {
+    return !(flags & RESTORE_UNLOCK_TRAILERS);
+  }
+  return false;
+}
+
+static bool isValid(const MifareImage& image, uint8_t block) {
+  return (image.validMask >> block) & 1;
+}
+
+/**
+ * @brief Check that the access bits of a trailer match their complement
+ *
+ * Bytes 6 to 8 hold C1, C2 and C3 for the four blocks of the sector, each
+ * one next to its inverted copy. A mismatch makes the sector unusable.
+ */
+static bool hasValidAccessBits(const uint8_t* trailer) {
+  uint8_t c1 = trailer[7] >> 4;
+  uint8_t c2 = trailer[8] & 0x0F;
+  uint8_t c3 = trailer[8] >> 4;
+
+  return ((trailer[6] & 0x0F) == (~c1 & 0x0F)) &&
+         ((trailer[6] >> 4) == (~c2 & 0x0F)) &&
+         ((trailer[7] & 0x0F) == (~c3 & 0x0F));
+}
+
+/**
+ * @brief Check whether the access bits let key B be read back
+ *
+ * Key B is readable with trailer conditions C1C2C3 000, 010 and 001, and
+ * reads back as zeros otherwise.
+ */
+static bool isKeyBReadable(const uint8_t* trailer) {
+  uint8_t c1 = (trailer[7] >> 7) & 1;
+  uint8_t c2 = (trailer[8] >> 3) & 1;
+  uint8_t c3 = (trailer[8] >> 7) & 1;
+
+  return c1 == 0 && !(c2 && c3);
+}
+
+static bool isRejected(const MifareImage& image, uint8_t block) {
+  if (!isTrailer(block)) {
+    return false;
+  }
+
+  const uint8_t* trailer = image.blocks[block];
+  if (!hasValidAccessBits(trailer)) {
+    return true;
+  }
+
+  // Zeroed keys usually come from a masked read, not a wanted key
+  bool zeroKeyA = memcmp(trailer, zeroKey, sizeof(zeroKey)) == 0;
+  bool maskedKeyB = !isKeyBReadable(trailer) &&
+                    memcmp(&trailer[10], zeroKey, sizeof(zeroKey)) == 0;
+  uint8_t sector = block / MFC_BLOCKS_PER_SECTOR;
+  return (zeroKeyA || maskedKeyB) && !((image.zeroKeyMask >> sector) & 1);
+}
+
+static void beginReport(MifareReport& report) {
+  memset(&report, 0, sizeof(report));
+  report.elapsedMs = millis();
+}
+
+void mifareClearImage(MifareImage& image) {
+  memset(&image, 0, sizeof(image));
+}
+
+bool mifareDumpCard(Electroniccats_PN7150& nfc,
+                    const uint8_t key[6],
+                    MifareImage& image,
+                    MifareReport& report) {
+  beginReport(report);
+  mifareClearImage(dumpImage);
+
+  bool success = true;
+  for (uint8_t sector = 0;
+       success && sector < MFC_1K_BLOCKS / MFC_BLOCKS_PER_SECTOR; sector++) {
+    success = authenticateSector(nfc, sector, key, report);
+
+    uint8_t first = sector * MFC_BLOCKS_PER_SECTOR;
+    for (uint8_t block = first;
+         success && block < first + MFC_BLOCKS_PER_SECTOR; block++) {
+      success = readBlock(nfc, block, dumpImage.blocks[block], report);
+      if (success) {
+        // Key A reads back masked, keep the one that opened the sector
+        if (isTrailer(block)) {
+          memcpy(dumpImage.blocks[block], key, 6);
+
+          // A 00..00 key that opened the sector is real, but a hidden key B
+          // still reads as zeros and must stay rejected
+          if (memcmp(key, zeroKey, sizeof(zeroKey)) == 0 &&
+              isKeyBReadable(dumpImage.blocks[block])) {
+            dumpImage.zeroKeyMask |= 1 << sector;
+          }
+        }
+        dumpImage.validMask |= (uint64_t) 1 << block;
+      }
+    }
+  }
+
+  if (success) {
+    memcpy(&image, &dumpImage, sizeof(image));
+  }
+
+  report.elapsedMs = millis() - report.elapsedMs;
+  return success;
+}
+
+/**
+ * @brief Compare a block read from the card with the image
+ *
+ * Trailers leave out key A, which always reads back masked, and key B when
+ * the access bits read from the card hide it.
+ */
+static bool matchesImage(const uint8_t* current,
+                         const uint8_t* target,
+                         uint8_t block) {
+  if (!isTrailer(block)) {
+    return memcmp(current, target, MFC_BLOCK_SIZE) == 0;
+  }
+
+  uint8_t length = isKeyBReadable(current) ? MFC_BLOCK_SIZE - 6 : 4;
+  return memcmp(&current[6], &target[6], length) == 0;
+}
+
+/**
+ * @brief Bring one block of an authenticated sector in line with the image
+ *
+ * @return bool false if the card failed to read, write or verify the block
+ */
+static bool restoreBlock(Electroniccats_PN7150& nfc,
+                         const uint8_t key[6],
+                         const MifareImage& image,
+                         uint8_t block,
+                         MifareReport& report) {
+  uint8_t current[MFC_BLOCK_SIZE];
+
+  if (!readBlock(nfc, block, current, report)) {
+    return false;
+  }
+
+  // Key A reads back masked, it is the key this session opened with
+  if ((!isTrailer(block) || memcmp(key, image.blocks[block], 6) == 0) &&
+      matchesImage(current, image.blocks[block], block)) {
+    report.blocksUnchanged++;
+    return true;
+  }
+
+  if (!writeBlock(nfc, block, image.blocks[block], report) ||
+      !readBlock(nfc, block, current, report)) {
+    return false;
+  }
+
+  if (!matchesImage(current, image.blocks[block], block)) {
+    report.error = "Verify failed!";
+    return false;
+  }
+
+  report.blocksWritten++;
+  return true;
+}
+
+static bool isPending(const MifareImage& image, uint8_t block, uint8_t flags) {
+  return isValid(image, block) && !isProtected(block, flags) &&
+         !isRejected(image, block);
+}
+
+/**
+ * @brief Authenticate a sector, falling back to the key A of the image
+ *
+ * An earlier restore may have given the sector the image key, so when key is
+ * refused the tag is re-activated, as a refused auth halts it, and the image
+ * trailer key is tried.
+ *
+ * @return const uint8_t* Key that opened the sector, NULL if none did
+ */
+static const uint8_t* openSector(Electroniccats_PN7150& nfc,
+                                 uint8_t sector,
+                                 const uint8_t key[6],
+                                 const MifareImage& image,
+                                 MifareReport& report) {
+  if (authenticateSector(nfc, sector, key, report)) {
+    return key;
+  }
+
+  uint8_t trailer = sector * MFC_BLOCKS_PER_SECTOR + MFC_BLOCKS_PER_SECTOR - 1;
+  const uint8_t* imageKey = image.blocks[trailer];
+  if (!isValid(image, trailer) || isRejected(image, trailer) ||
+      memcmp(imageKey, key, 6) == 0) {
+    return NULL;
+  }
+
+  report.roundTrips++;
+  nfc.readerReActivate();
+  if (!authenticateSector(nfc, sector, imageKey, report)) {
+    return NULL;
+  }
+
+  report.error = NULL;
+  return imageKey;
+}
+
+bool mifareRestoreCard(Electroniccats_PN7150& nfc,
+                       const uint8_t key[6],
+                       const MifareImage& image,
+                       uint8_t flags,
+                       MifareReport& report) {
+  beginReport(report);
+
+  bool success = true;
+  for (uint8_t sector = 0;
+       success && sector < MFC_1K_BLOCKS / MFC_BLOCKS_PER_SECTOR; sector++) {
+    uint8_t first = sector * MFC_BLOCKS_PER_SECTOR;
+
+    // Skip the authentication when the sector has nothing to write
+    bool pending = false;
+    for (uint8_t block = first; block < first + MFC_BLOCKS_PER_SECTOR;
+         block++) {
+      if (!isValid(image, block)) {
+        continue;
+      }
+      if (isProtected(block, flags)) {
+        report.blocksSkipped++;
+      } else if (isRejected(image, block)) {
+        report.blocksRejected++;
+      } else if (block != 0) {
+        pending = true;
+      }
+    }
+
+    if (!pending) {
+      continue;
+    }
+
+    const uint8_t* sessionKey = openSector(nfc, sector, key, image, report);
+    success = sessionKey != NULL;
+
+    // Trailer is the last block, so new keys only apply after the data
+    for (uint8_t block = first;
+         success && block < first + MFC_BLOCKS_PER_SECTOR; block++) {
+      if (block != 0 && isPending(image, block, flags)) {
+        success = restoreBlock(nfc, sessionKey, image, block, report);
+      }
+    }
+  }
+
+  // Only magic cards accept block 0 writes, and a refused write halts the
+  // tag, so it goes last and a failure only skips that block
+  if (success && isPending(image, 0, flags)) {
+    const uint8_t* sessionKey = openSector(nfc, 0, key, image, report);
+
+    if (sessionKey == NULL ||
+        !restoreBlock(nfc, sessionKey, image, 0, report)) {
+      report.blocksSkipped++;
+      report.error = NULL;
+    }
+  }
+
+  report.elapsedMs = millis() - report.elapsedMs;
+  return success;
+}
+
+bool mifareParseImageLine(MifareImage& image, const String& line) {
+  int separator = line.indexOf(':');
+  if (separator < 1 || separator > 2) {
+    return false;
+  }
+
+  // toInt() turns anything that is not a number into block 0
+  for (int i = 0; i < separator; i++) {
+    if (!isdigit(line[i])) {
+      return false;
+    }
+  }
+
+  long block = line.substring(0, separator).toInt();
+  if (block >= MFC_1K_BLOCKS) {
+    return false;
+  }
+
+  // A trailing '!' confirms that 00..00 keys in a trailer are real
+  unsigned int dataEnd = line.length();
+  bool allowZeroKey = line.endsWith("!");
+  if (allowZeroKey) {
+    dataEnd--;
+  }
+
+  if (dataEnd - separator - 1 != MFC_BLOCK_SIZE * 2 ||
+      (allowZeroKey && !isTrailer(block))) {
+    return false;
+  }
+
+  uint8_t data[MFC_BLOCK_SIZE];
+  for (uint8_t i = 0; i < MFC_BLOCK_SIZE; i++) {
+    char hex[3] = {line[separator + 1 + i * 2], line[separator + 2 + i * 2],
+                   '\0'};
+    if (!isxdigit(hex[0]) || !isxdigit(hex[1])) {
+      return false;
+    }
+    data[i] = strtoul(hex, NULL, 16);
+  }
+
+  uint8_t sector = block / MFC_BLOCKS_PER_SECTOR;
+  if (allowZeroKey) {
+    image.zeroKeyMask |= 1 << sector;
+  } else if (isTrailer(block)) {
+    image.zeroKeyMask &= ~(1 << sector);
+  }
+
+  memcpy(image.blocks[block], data, MFC_BLOCK_SIZE);
+  image.validMask |= (uint64_t) 1 << block;
+  return true;
+}
+
+void mifareExportImage(const MifareImage& image) {
+  Serial.println("# mifare-image");
+
+  for (uint8_t block = 0; block < MFC_1K_BLOCKS; block++) {
+    if (!isValid(image, block)) {
+      continue;
+    }
+
+    // Add leading zero for block numbers less than 10
+    if (block < 10)
+      Serial.print("0");
+    Serial.print(block);
+    Serial.print(":");
+    for (uint8_t i = 0; i < MFC_BLOCK_SIZE; i++) {
+      if (image.blocks[block][i] <= 0xF)
+        Serial.print("0");
+      Serial.print(image.blocks[block][i], HEX);
+    }
+    if (isTrailer(block) &&
+        ((image.zeroKeyMask >> (block / MFC_BLOCKS_PER_SECTOR)) & 1)) {
+      Serial.print("!");
+    }
+    Serial.println();
+  }
+
+  Serial.println("end");
+}
+
+void mifarePrintReport(const MifareReport& report) {
+  Serial.print("Blocks read: ");
+  Serial.println(report.blocksRead);
+  Serial.print("Blocks written: ");
+  Serial.println(report.blocksWritten);
+  Serial.print("Blocks unchanged: ");
+  Serial.println(report.blocksUnchanged);
+  Serial.print("Blocks skipped: ");
+  Serial.println(report.blocksSkipped);
+  Serial.print("Trailers rejected: ");
+  Serial.println(report.blocksRejected);
+  Serial.print("Sectors authenticated: ");
+  Serial.println(report.sectorsAuthenticated);
+  Serial.print("Round trips: ");
+  Serial.println(report.roundTrips);
+  Serial.print("Elapsed ms: ");
+  Serial.println(report.elapsedMs);
+  if (report.error != NULL) {
+    Serial.print("Error: ");
+    Serial.println(report.error);
+  }
+}
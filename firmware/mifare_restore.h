@@ -0,0 +1,123 @@
+/**
+ * @file mifare_restore.h
+ * @brief MIFARE Classic card image dump and restore functions
+ * @author Francisco Torres - Electronic Cats - electroniccats.com
+ * @date May 2025
+ *
+ * This file contains functions to dump a MIFARE Classic 1K card into a RAM
+ * image, load an image over serial and restore it to a card. Restore only
+ * writes blocks that differ from the card, authenticating each sector once
+ * and verifying every write in the same session.
+ */
+
+#ifndef MIFARE_RESTORE_H
+#define MIFARE_RESTORE_H
+
+#include <Arduino.h>
+#include "Electroniccats_PN7150.h"
+#include "nfc_config.h"
+
+/**
+ * @brief Restore options
+ */
+#define RESTORE_UNLOCK_BLOCK0   (0x01)  ///< Allow writing manufacturer block
+#define RESTORE_UNLOCK_TRAILERS (0x02)  ///< Allow writing sector trailers
+
+/**
+ * @brief Full MIFARE Classic 1K card image
+ */
+typedef struct {
+  uint8_t blocks[MFC_1K_BLOCKS][MFC_BLOCK_SIZE];  // Block contents
+  uint64_t validMask;                             // Bit n set if block n loaded
+  uint16_t zeroKeyMask;  // Bit n set if sector n may be given 00..00 keys
+} MifareImage;
+
+/**
+ * @brief Statistics of a dump or restore operation
+ */
+typedef struct {
+  uint16_t blocksRead;            // Blocks read from the card
+  uint16_t blocksWritten;         // Blocks written and verified
+  uint16_t blocksUnchanged;       // Blocks already matching the image
+  uint16_t blocksSkipped;         // Protected blocks left untouched
+  uint16_t blocksRejected;        // Unsafe trailers left untouched
+  uint16_t sectorsAuthenticated;  // Sector authentications performed
+  uint16_t roundTrips;            // readerTagCmd() calls issued
+  uint32_t elapsedMs;             // Duration of the operation
+  const char* error;              // Error message, NULL on success
+} MifareReport;
+
+/**
+ * @brief Discard all data in an image
+ *
+ * @param image Image to clear
+ */
+void mifareClearImage(MifareImage& image);
+
+/**
+ * @brief Read every block of the card into an image
+ *
+ * The card masks key A when a trailer is read, so the key used to
+ * authenticate is stored in its place, and marked through zeroKeyMask when
+ * it is 00..00. The image is left untouched if any sector cannot be read.
+ *
+ * @param nfc Reference to NFC controller object
+ * @param key Key A used to authenticate each sector
+ * @param image Image receiving the card contents
+ * @param report Statistics of the operation
+ * @return bool true if the whole card was read
+ */
+bool mifareDumpCard(Electroniccats_PN7150& nfc,
+                    const uint8_t key[6],
+                    MifareImage& image,
+                    MifareReport& report);
+
+/**
+ * @brief Write an image to the card
+ *
+ * Only blocks that differ from the card are written. Block 0 and sector
+ * trailers are skipped unless unlocked through flags. Trailers with broken
+ * access bits, or with key A or a hidden key B of 00..00 not allowed through
+ * zeroKeyMask, are rejected since writing them would lock the sector.
+ *
+ * @param nfc Reference to NFC controller object
+ * @param key Key A used to authenticate each sector, the image trailer key
+ *            is tried when it is refused
+ * @param image Image to restore
+ * @param flags Combination of RESTORE_UNLOCK_* options
+ * @param report Statistics of the operation
+ * @return bool true if every changed block was written and verified
+ */
+bool mifareRestoreCard(Electroniccats_PN7150& nfc,
+                       const uint8_t key[6],
+                       const MifareImage& image,
+                       uint8_t flags,
+                       MifareReport& report);
+
+/**
+ * @brief Parse one image line in the "BB:HEX" format used by the export
+ *
+ * A trailer line may end with '!' to confirm that 00..00 keys in it are
+ * real rather than masked by the card.
+ *
+ * @param image Image receiving the block
+ * @param line Block number in decimal, a colon and 32 hex characters
+ * @return bool true if the line held a valid block
+ */
+bool mifareParseImageLine(MifareImage& image, const String& line);
+
+/**
+ * @brief Print the valid blocks of an image via Serial
+ *
+ * @param image Image to print
+ */
+void mifareExportImage(const MifareImage& image);
+
+/**
+ * @brief Print operation statistics via Serial
+ *
+ * @param report Statistics to print
+ */
+void mifarePrintReport(const MifareReport& report);
+
+#endif  // MIFARE_RESTORE_H
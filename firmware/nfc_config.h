@@ -28,4 +28,17 @@
  */
 #define DETECTION_DELAY_MS (500)  ///< Delay between detection attempts
 
+/**
+ * @brief Reader capture log configuration
+ */
+#define CAPTURE_LOG_FRAMES  (64)  ///< Frames kept in the capture ring buffer
+#define CAPTURE_FRAME_BYTES (32)  ///< Bytes stored per frame, rest truncated
+
+/**
+ * @brief MIFARE Classic 1K layout
+ */
+#define MFC_BLOCK_SIZE        (16)  ///< Bytes per block
+#define MFC_BLOCKS_PER_SECTOR (4)   ///< Blocks per sector, trailer is the last
+#define MFC_1K_BLOCKS         (64)  ///< Blocks in a MIFARE Classic 1K card
+
 #endif  // NFC_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,194 @@
+/**
+ * @file reader_capture.cpp
+ * @brief Implementation of the reader command capture log
+ * @author Francisco Torres - Electronic Cats - electroniccats.com
+ * @date May 2025
+ */
+
+#include "reader_capture.h"
+#include "T4T_NDEF_emu.h"
+
+// Create global instance
+ReaderCapture readerCapture;
+
+ReaderCapture::ReaderCapture() {
+  _session = 0;
+  clear();
+}
+
+void ReaderCapture::clear() {
+  _head = 0;
+  _count = 0;
+  _dropped = 0;
+}
+
+uint16_t ReaderCapture::beginSession() {
+  return ++_session;
+}
+
+void ReaderCapture::record(uint32_t timestampUs,
+                           const uint8_t* data,
+                           uint8_t length) {
+  CapturedFrame* frame = &_frames[_head];
+  uint8_t stored = min(length, (uint8_t) CAPTURE_FRAME_BYTES);
+
+  frame->timestampUs = timestampUs;
+  frame->session = _session;
+  frame->length = length;
+  memcpy(frame->data, data, stored);
+
+  _head = (_head + 1) % CAPTURE_LOG_FRAMES;
+  if (_count < CAPTURE_LOG_FRAMES) {
+    _count++;
+  } else {
+    _dropped++;
+  }
+}
+
+uint16_t ReaderCapture::getCount() {
+  return _count;
+}
+
+uint32_t ReaderCapture::getDropped() {
+  return _dropped;
+}
+
+const CapturedFrame* ReaderCapture::getFrame(uint16_t index) {
+  if (index >= _count) {
+    return NULL;
+  }
+
+  // Oldest frame sits right after the newest one once the buffer wraps
+  uint16_t oldest = (_head + CAPTURE_LOG_FRAMES - _count) % CAPTURE_LOG_FRAMES;
+  return &_frames[(oldest + index) % CAPTURE_LOG_FRAMES];
+}
+
+uint32_t ReaderCapture::getGapUs(uint16_t index) {
+  const CapturedFrame* frame = getFrame(index);
+  if (frame == NULL || index == 0) {
+    return 0;
+  }
+
+  const CapturedFrame* previous = getFrame(index - 1);
+  if (previous->session != frame->session) {
+    return 0;
+  }
+
+  // Unsigned subtraction keeps the gap valid across micros() overflow
+  return frame->timestampUs - previous->timestampUs;
+}
+
+void ReaderCapture::exportToSerial() {
+  Serial.print("# reader-capture frames=");
+  Serial.print(_count);
+  Serial.print(" dropped=");
+  Serial.print(_dropped);
+  Serial.print(" max_bytes=");
+  Serial.println(CAPTURE_FRAME_BYTES);
+  Serial.println("# session,index,timestamp_us,gap_us,length,data");
+
+  for (uint16_t i = 0; i < _count; i++) {
+    const CapturedFrame* frame = getFrame(i);
+    uint8_t stored = min(frame->length, (uint8_t) CAPTURE_FRAME_BYTES);
+
+    Serial.print(frame->session);
+    Serial.print(",");
+    Serial.print(i);
+    Serial.print(",");
+    Serial.print(frame->timestampUs);
+    Serial.print(",");
+    Serial.print(getGapUs(i));
+    Serial.print(",");
+    Serial.print(frame->length);
+    Serial.print(",");
+    for (uint8_t b = 0; b < stored; b++) {
+      // Add leading zero for values less than 0x10
+      if (frame->data[b] <= 0xF)
+        Serial.print("0");
+      Serial.print(frame->data[b], HEX);
+    }
+    Serial.println();
+  }
+
+  Serial.println("# end");
+}
+
+/**
+ * @brief Wait for the next NCI message from the controller
+ *
+ * @param nfc Reference to NFC controller object
+ * @param buffer Buffer receiving the message
+ * @param timeoutMs Maximum time to wait in milliseconds
+ * @return uint32_t Message length, 0 on timeout
+ */
+static uint32_t receiveMessage(Electroniccats_PN7150& nfc,
+                               uint8_t* buffer,
+                               unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (nfc.hasMessage()) {
+      return nfc.readData(buffer);
+    }
+  }
+  return 0;
+}
+
+uint16_t captureCardEmulation(Electroniccats_PN7150& nfc) {
+  uint8_t Rx[MAX_NCI_FRAME_SIZE];
+  uint8_t Tx[MAX_NCI_FRAME_SIZE];
+  uint8_t NCIStopDiscovery[] = {0x21, 0x06, 0x01, 0x00};
+  unsigned short RespSize;
+  bool firstCmd = true;
+  uint16_t captured = 0;
+
+  readerCapture.beginSession();
+
+  /* Reset Card emulation state */
+  T4T_NDEF_EMU_Reset();
+
+  // Mirrors the library's processCardMode(), which handleCardEmulation()
+  // runs, with each DATA packet also recorded in the capture log
+  uint32_t rxLength = receiveMessage(nfc, Rx, 2000);
+  while (rxLength > 0) {
+    uint32_t timestampUs = micros();
+
+    /* is RF_DEACTIVATE_NTF ? */
+    if ((Rx[0] == 0x61) && (Rx[1] == 0x06)) {
+      if (firstCmd) {
+        /* Restart the discovery loop */
+        (void) nfc.writeData(NCIStopDiscovery, sizeof(NCIStopDiscovery));
+        do {
+          rxLength = receiveMessage(nfc, Rx, 100);
+        } while (rxLength > 0 && !((Rx[0] == 0x41) && (Rx[1] == 0x06)));
+        nfc.startDiscovery();
+      }
+      /* Come back to discovery state */
+      break;
+    }
+
+    /* is DATA_PACKET ? Other packets, e.g. CORE_CONN_CREDITS_NTF, are
+     * ignored */
+    if ((Rx[0] == 0x00) && (Rx[1] == 0x00)) {
+      uint8_t CmdSize = Rx[2];
+
+      T4T_NDEF_EMU_Next(&Rx[3], CmdSize, &Tx[3], &RespSize);
+      if (RespSize > sizeof(Tx) - 3) {
+        RespSize = 0;
+      }
+
+      Tx[0] = 0x00;
+      Tx[1] = (RespSize & 0xFF00) >> 8;
+      Tx[2] = RespSize & 0x00FF;
+      (void) nfc.writeData(Tx, RespSize + 3);
+
+      // Log only after answering so the reader never waits on the capture
+      readerCapture.record(timestampUs, &Rx[3], CmdSize);
+      captured++;
+    }
+
+    firstCmd = false;
+    rxLength = receiveMessage(nfc, Rx, 2000);
+  }
+
+  return captured;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file reader_capture.h
+ * @brief Capture log for reader commands received in card emulation mode
+ * @author Francisco Torres - Electronic Cats - electroniccats.com
+ * @date May 2025
+ *
+ * This file contains a preallocated ring buffer that records every frame a
+ * reader sends while the badge emulates a tag, together with a microsecond
+ * timestamp, so the command sequence can be browsed or exported later.
+ */
+
+#ifndef READER_CAPTURE_H
+#define READER_CAPTURE_H
+
+#include <Arduino.h>
+#include "Electroniccats_PN7150.h"
+#include "nfc_config.h"
+
+/**
+ * @brief Single frame received from a reader
+ */
+typedef struct {
+  uint32_t timestampUs;               // micros() when the frame arrived
+  uint16_t session;                   // Reader session the frame belongs to
+  uint8_t length;                     // Original frame length in bytes
+  uint8_t data[CAPTURE_FRAME_BYTES];  // Frame bytes, truncated if needed
+} CapturedFrame;
+
+class ReaderCapture {
+ public:
+  /**
+   * @brief Constructor, starts with an empty log
+   */
+  ReaderCapture();
+
+  /**
+   * @brief Discard all captured frames
+   */
+  void clear();
+
+  /**
+   * @brief Start a new reader session
+   *
+   * @return uint16_t Identifier of the new session
+   */
+  uint16_t beginSession();
+
+  /**
+   * @brief Store a frame, overwriting the oldest one when the log is full
+   *
+   * @param timestampUs micros() value taken when the frame arrived
+   * @param data Pointer to frame bytes
+   * @param length Number of bytes in the frame
+   */
+  void record(uint32_t timestampUs, const uint8_t* data, uint8_t length);
+
+  /**
+   * @brief Get the number of frames currently stored
+   */
+  uint16_t getCount();
+
+  /**
+   * @brief Get the number of frames overwritten since the last clear
+   */
+  uint32_t getDropped();
+
+  /**
+   * @brief Get a stored frame
+   *
+   * @param index Position in the log, 0 is the oldest frame
+   * @return const CapturedFrame* Frame, or NULL if index is out of range
+   */
+  const CapturedFrame* getFrame(uint16_t index);
+
+  /**
+   * @brief Get microseconds elapsed since the previous frame of the session
+   *
+   * @param index Position in the log, 0 is the oldest frame
+   * @return uint32_t Gap in microseconds, 0 for the first frame of a session
+   */
+  uint32_t getGapUs(uint16_t index);
+
+  /**
+   * @brief Print the whole log through Serial in a host-parsable format
+   */
+  void exportToSerial();
+
+ private:
+  CapturedFrame _frames[CAPTURE_LOG_FRAMES];
+  uint16_t _head;     // Next slot to write
+  uint16_t _count;    // Frames stored
+  uint32_t _dropped;  // Frames overwritten
+  uint16_t _session;  // Current session identifier
+};
+
+extern ReaderCapture readerCapture;
+
+/**
+ * @brief Answer a reader in card emulation mode, recording its commands
+ *
+ * Runs the same NCI exchange as nfc.handleCardEmulation(), including the
+ * discovery restart when the first message is a deactivation, and
+ * feeds every received DATA packet into readerCapture. Frames are stored
+ * after the answer is sent, so the capture does not add latency.
+ *
+ * @param nfc Reference to NFC controller object
+ * @return uint16_t Number of frames captured during the session
+ */
+uint16_t captureCardEmulation(Electroniccats_PN7150& nfc);
+
+#endif  // READER_CAPTURE_H
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Summarise a reader capture log exported by the badge.
+
+Run "NFC > Reader log > Export log" on the badge and save the serial output
+(9600 baud) to a file, for example:
+
+    arduino-cli monitor -p /dev/ttyACM0 > capture.txt
+    python3 firmware/tools/reader_capture_summary.py capture.txt
+
+Use "-" to read the log from standard input.
+"""
+
+import argparse
+import statistics
+import sys
+
+# ISO 7816-4 / EMV instructions most readers send
+INSTRUCTIONS = {
+    0x20: "VERIFY",
+    0x82: "EXTERNAL AUTH",
+    0x84: "GET CHALLENGE",
+    0x88: "INTERNAL AUTH",
+    0xA4: "SELECT",
+    0xA8: "GET PROCESSING OPTIONS",
+    0xAE: "GENERATE AC",
+    0xB0: "READ BINARY",
+    0xB2: "READ RECORD",
+    0xC0: "GET RESPONSE",
+    0xCA: "GET DATA",
+    0xD6: "UPDATE BINARY",
+}
+
+
+def parse_log(lines):
+    """Return a dict mapping session id to its list of frames."""
+    sessions = {}
+    for line in lines:
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        fields = line.split(",")
+        if len(fields) != 6:
+            continue
+        try:
+            session, index, timestamp, gap, length = (int(f) for f in fields[:5])
+            data = bytes.fromhex(fields[5])
+        except ValueError:
+            continue
+        sessions.setdefault(session, []).append({
+            "index": index,
+            "timestamp": timestamp,
+            "gap": gap,
+            "length": length,
+            "data": data,
+        })
+    return sessions
+
+
+def describe(frame):
+    """Return a short human readable description of a command APDU."""
+    data = frame["data"]
+    if len(data) < 4:
+        return data.hex().upper()
+
+    cla, ins, p1, p2 = data[0], data[1], data[2], data[3]
+    name = INSTRUCTIONS.get(ins, "INS %02X" % ins)
+    text = "%s (CLA %02X P1 %02X P2 %02X)" % (name, cla, p1, p2)
+
+    # SELECT by name carries the AID in the command data
+    if ins == 0xA4 and p1 == 0x04 and len(data) > 5:
+        lc = data[4]
+        text += " AID " + data[5:5 + lc].hex().upper()
+
+    if frame["length"] > len(data):
+        text += " [truncated %d/%d]" % (len(data), frame["length"])
+    return text
+
+
+def summarise(sessions):
+    for session, frames in sorted(sessions.items()):
+        gaps = [f["gap"] for f in frames[1:]]
+        print("Reader session %d: %d frames" % (session, len(frames)))
+        if gaps:
+            print("  gaps us: min %d, mean %d, max %d, total %d" %
+                  (min(gaps), statistics.mean(gaps), max(gaps), sum(gaps)))
+
+        for frame in frames:
+            print("  %+10dus  %s" % (frame["gap"], describe(frame)))
+
+        aids = sorted({
+            f["data"][5:5 + f["data"][4]].hex().upper()
+            for f in frames
+            if len(f["data"]) > 5 and f["data"][1] == 0xA4 and
+            f["data"][2] == 0x04
+        })
+        if aids:
+            print("  AIDs selected: " + ", ".join(aids))
+        print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("log", help="exported capture log, or - for stdin")
+    args = parser.parse_args()
+
+    if args.log == "-":
+        sessions = parse_log(sys.stdin)
+    else:
+        with open(args.log) as log:
+            sessions = parse_log(log)
+
+    if not sessions:
+        print("No frames found in the log")
+        return 1
+
+    summarise(sessions)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())